@@ -0,0 +1,172 @@
+/*
+    lept_parse 的模糊测试和差分测试
+
+    同一个输入分别用下面几种方式解析，要求错误码和解析出的树完全一致：
+      1. lept_parse 原样解析
+      2. 在前面（解析成功时也在后面）加上空白字符再解析
+      3. 定义了 LEPT_PARSE_STATS 时，用 lept_parse_with_stats 解析
+    另外，解析成功时：
+      - 把结果 merge patch 到一个固定的 target 上，结果必须和直接解析出来的一样；
+      - 用 lept_stringify_to 生成 json 再解析，结果必须不变。
+    以后加入新的解析路径（快速数字、原地解析等）时，也应该加到 lept_fuzz_one 里面和参考结果比较。
+
+    定义 LEPT_FUZZ_STANDALONE 时编译出一个 main，依次读取命令行给出的文件，用于在 ctest 中回放种子语料；
+    否则作为 libFuzzer 的目标，用 clang -fsanitize=fuzzer 编译。
+*/
+#include <stdio.h>
+#include <stdlib.h> /* malloc() free() abort() */
+#include <string.h>
+#include "leptjson.h"
+
+#define FUZZ_CHECK(cond)\
+    do {\
+        if (!(cond)) {\
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);\
+            abort();\
+        }\
+    } while(0)
+
+/* 比较两棵树，数字按位比较（-0.0 和 0.0 也要区分） */
+static int lept_fuzz_same_tree(const lept_value* a, const lept_value* b){
+    size_t i;
+    if (a->type != b->type)
+        return 0;
+    switch (a->type) {
+        case LEPT_NUMBER:
+            return memcmp(&a->u.n, &b->u.n, sizeof(double)) == 0;
+        case LEPT_STRING:
+            return a->u.s.len == b->u.s.len && memcmp(a->u.s.s, b->u.s.s, a->u.s.len) == 0;
+        case LEPT_ARRAY:
+            if (a->u.a.size != b->u.a.size)
+                return 0;
+            for (i = 0; i < a->u.a.size; i++)
+                if (!lept_fuzz_same_tree(&a->u.a.e[i], &b->u.a.e[i]))
+                    return 0;
+            return 1;
+        default:
+            return 1;
+    }
+}
+
+typedef struct {
+    char* buf;
+    size_t len, size;
+} lept_fuzz_sink_ctx;
+
+static int lept_fuzz_sink(void* ctx, const char* data, size_t len){
+    lept_fuzz_sink_ctx* t = (lept_fuzz_sink_ctx*)ctx;
+    if (t->len + len + 1 > t->size) {
+        while (t->len + len + 1 > t->size)
+            t->size = t->size ? t->size * 2 : 64;
+        t->buf = (char*)realloc(t->buf, t->size);
+    }
+    memcpy(t->buf + t->len, data, len);
+    t->len += len;
+    t->buf[t->len] = '\0';
+    return 0;
+}
+
+/* 解析结果要满足的基本约束 */
+static void lept_fuzz_check_result(const lept_value* v, int ret){
+    if (ret != LEPT_PARSE_OK)
+        FUZZ_CHECK(v->type == LEPT_NULL); /* 出错时 v 必须是 null */
+    if (v->type == LEPT_STRING)
+        FUZZ_CHECK(v->u.s.s[v->u.s.len] == '\0');
+}
+
+static void lept_fuzz_one(const char* json, size_t len){
+    lept_value ref, v;
+    int ret;
+    char* padded;
+
+    lept_init(&ref);
+    ret = lept_parse(&ref, json);
+    lept_fuzz_check_result(&ref, ret);
+
+    /* 前后的空白字符不影响结果；没闭合的字符串后面加上 "\r\n" 会变成 INVALID_STRING_CHAR，所以只在成功时加在后面 */
+    padded = (char*)malloc(len + 5);
+    memcpy(padded, " \t", 2);
+    memcpy(padded + 2, json, len);
+    memcpy(padded + 2 + len, ret == LEPT_PARSE_OK ? "\r\n" : "", ret == LEPT_PARSE_OK ? 3 : 1);
+    lept_init(&v);
+    FUZZ_CHECK(lept_parse(&v, padded) == ret);
+    FUZZ_CHECK(lept_fuzz_same_tree(&ref, &v));
+    lept_free(&v);
+    free(padded);
+
+    /* target 里有长短不同的字符串和数组，覆盖 lept_merge_patch 复用内存的各种情况 */
+    if (ret == LEPT_PARSE_OK) {
+        lept_init(&v);
+        FUZZ_CHECK(lept_parse(&v, "[\"abcdef\", [1, \"x\", [2]], \"\", null]") == LEPT_PARSE_OK);
+        lept_merge_patch(&v, &ref);
+        FUZZ_CHECK(lept_equal(&v, &ref));
+        FUZZ_CHECK(lept_fuzz_same_tree(&ref, &v));
+        lept_free(&v);
+    }
+
+    /* chunk 取 3，让缓冲边界落在转义序列和数字中间 */
+    if (ret == LEPT_PARSE_OK) {
+        lept_fuzz_sink_ctx out = { NULL, 0, 0 };
+        FUZZ_CHECK(lept_stringify_to(&ref, lept_fuzz_sink, &out, 3) == LEPT_STRINGIFY_OK);
+        lept_init(&v);
+        FUZZ_CHECK(lept_parse(&v, out.buf) == LEPT_PARSE_OK);
+        FUZZ_CHECK(lept_fuzz_same_tree(&ref, &v));
+        lept_free(&v);
+        free(out.buf);
+    }
+
+#ifdef LEPT_PARSE_STATS
+    {
+        lept_stats stats;
+        lept_init(&v);
+        FUZZ_CHECK(lept_parse_with_stats(&v, json, &stats) == ret);
+        FUZZ_CHECK(lept_fuzz_same_tree(&ref, &v));
+        if (ret == LEPT_PARSE_OK)
+            FUZZ_CHECK(stats.bytes == len);
+        lept_free(&v);
+    }
+#endif
+
+    lept_free(&ref);
+}
+
+int LLVMFuzzerTestOneInput(const unsigned char* data, size_t size){
+    char* json;
+    size_t len;
+    /* lept_parse 只接受以 '\0' 结尾的字符串，所以复制一份；中间的 '\0' 之后的内容被忽略 */
+    json = (char*)malloc(size + 1);
+    memcpy(json, data, size);
+    json[size] = '\0';
+    len = strlen(json);
+    lept_fuzz_one(json, len);
+    free(json);
+    return 0;
+}
+
+#ifdef LEPT_FUZZ_STANDALONE
+int main(int argc, char* argv[]){
+    int i;
+    for (i = 1; i < argc; i++) {
+        FILE* fp;
+        unsigned char* data;
+        long size;
+        if ((fp = fopen(argv[i], "rb")) == NULL) {
+            fprintf(stderr, "cannot open %s\n", argv[i]);
+            return 1;
+        }
+        fseek(fp, 0, SEEK_END);
+        size = ftell(fp);
+        fseek(fp, 0, SEEK_SET);
+        data = (unsigned char*)malloc(size + 1); /* +1 避免 size 为 0 时 malloc(0) */
+        if (fread(data, 1, size, fp) != (size_t)size) {
+            fprintf(stderr, "cannot read %s\n", argv[i]);
+            return 1;
+        }
+        fclose(fp);
+        LLVMFuzzerTestOneInput(data, (size_t)size);
+        free(data);
+    }
+    printf("%d inputs passed\n", argc - 1);
+    return 0;
+}
+#endif
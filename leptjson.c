@@ -1,6 +1,10 @@
 #include <stdlib.h> /* NULL strtod() */
 #include <assert.h> // "assert()"
 #include <memory.h>
+#include <stdio.h>  /* sprintf() */
+#include <stdint.h> /* uint64_t */
+#include <errno.h>  /* errno ERANGE */
+#include <math.h>   /* HUGE_VAL isfinite() */
 #include "leptjson.h"
 
 typedef struct 
@@ -8,12 +12,28 @@ typedef struct
     const char* json;
     char* stack;
     size_t size, top;
+#ifdef LEPT_PARSE_STATS
+    lept_stats* stats; /* 为 NULL 时不统计 */
+    size_t depth;      /* 当前数组嵌套深度 */
+#endif
 } lept_context;
 
 #define EXPECT(c, ch)       do { assert(*c->json == (ch)); c->json++; } while(0)
 #define ISDIGIT(ch)         ((ch) >= '0' && (ch) <= '9')
 #define ISDIGIT1TO9(ch)     ((ch) >= '1' && (ch) <= '9')
 
+#ifdef LEPT_PARSE_STATS
+#define STAT_ADD(c, field, n)   do { if ((c)->stats) (c)->stats->field += (n); } while(0)
+#define STAT_MAX(c, field, n)   do { if ((c)->stats && (c)->stats->field < (n)) (c)->stats->field = (n); } while(0)
+#define STAT_DEPTH_ENTER(c)     do { (c)->depth++; STAT_MAX(c, max_depth, (c)->depth); } while(0)
+#define STAT_DEPTH_LEAVE(c)     do { (c)->depth--; } while(0)
+#else /* 关闭时全部展开为空语句，不产生任何代码 */
+#define STAT_ADD(c, field, n)   do { } while(0)
+#define STAT_MAX(c, field, n)   do { } while(0)
+#define STAT_DEPTH_ENTER(c)     do { } while(0)
+#define STAT_DEPTH_LEAVE(c)     do { } while(0)
+#endif
+
 #define lept_set_null(v)    lept_free(v)
 /*
     获取结果
@@ -112,6 +132,7 @@ static int lept_parse_number(lept_context* c, lept_value* v){
     }
     /* 校验完成 */
 
+    errno = 0;
     v->u.n = strtod(c->json, &end); // 第二个参数 char** 如果遇到不符合条件而终止的字符，由end返回
     /* 例子： 
     char b[] = "1234.567qwer"; 
@@ -121,6 +142,9 @@ static int lept_parse_number(lept_context* c, lept_value* v){
     if (c->json == end) { // ??
         return LEPT_PARSE_INVALID_VALUE;
     }
+    if (errno == ERANGE && (v->u.n == HUGE_VAL || v->u.n == -HUGE_VAL)) { // 上溢得到的 inf 没法再生成合法的 json；下溢为 0 是可以的
+        return LEPT_PARSE_NUMBER_TOO_BIG;
+    }
     c->json = end; // ??
     v->type = LEPT_NUMBER;
     return LEPT_PARSE_OK;
@@ -128,6 +152,7 @@ static int lept_parse_number(lept_context* c, lept_value* v){
 }
 
 void lept_free(lept_value* v){
+    size_t i;
     assert(v != NULL);
     switch (v->type) {
         case LEPT_STRING:
@@ -135,8 +160,8 @@ void lept_free(lept_value* v){
             break;
         case LEPT_ARRAY: // todo 屏蔽之后 用内存泄露工具查看一下
             /* 先把array里面的元素释放，最后释放自己 */
-            for(int i=0; i < v->u.a.size; i++){
-                free(&v->u.a.e[i]);
+            for(i=0; i < v->u.a.size; i++){
+                lept_free(&v->u.a.e[i]); // 元素本身不是单独 malloc 的，只能释放元素内部分配的内存
             }
             free(v->u.a.e); // 这个数组也是memcpy分配的，也要释放自己
             break;
@@ -152,7 +177,8 @@ void lept_set_string(lept_value* v, const char* s, size_t len){
     assert(v != NULL && (s != NULL || len == 0)); // 注意这里，len=0是可以的
     lept_free(v); // 注意，先清空v中可能分配到的内存，比如原来有一串字符了
     v->u.s.s = (char*)malloc(len+1); // +1 因为多了一个结尾的0
-    memcpy(v->u.s.s, s, len); // 将字符复制到 v 中
+    if(len > 0) // 空字符串时 s 可能为 NULL（比如解析 "" 时堆栈还没有分配），不能传给 memcpy
+        memcpy(v->u.s.s, s, len); // 将字符复制到 v 中
     v->u.s.s[len] = '\0'; // 字符串结尾添加一个0
     v->u.s.len = len;
     v->type = LEPT_STRING;
@@ -184,9 +210,12 @@ static void* lept_context_push(lept_context* c, size_t size){
             c->size += c->size >> 1; // c->size * 1.5
         }
         c->stack = (char*)realloc(c->stack, c->size); /* c->stack 在初始化时为 NULL，realloc(NULL, size) 的行为是等价于 malloc(size) 的 */
+        STAT_ADD(c, stack_reallocs, 1);
+        STAT_MAX(c, stack_size, c->size);
     }
     ret = c->stack + c->top; // 返回起始的指针
     c->top += size; // 变更新的top位置
+    STAT_MAX(c, stack_peak, c->top);
     return ret;
 }
 
@@ -213,8 +242,8 @@ static const char* lept_parse_hex4(const char* p, unsigned* u){
         }else{
             return NULL;
         }
-        return p;
     }
+    return p; // 之前这一行写在循环里面，只解析了第一位就返回了
 }
 
 /* 编码成Unicode编码 */
@@ -250,6 +279,7 @@ static int lept_parse_string(lept_context* c, lept_value* v){
         case '\"': // 结尾的 "
             len = c->top - head;
             lept_set_string(v, (const char*)lept_context_pop(c, len), len);
+            STAT_ADD(c, string_bytes, len + 1);
             c->json = p;
             return LEPT_PARSE_OK;
             break;
@@ -289,11 +319,13 @@ static int lept_parse_string(lept_context* c, lept_value* v){
                         }
                         u = 0x10000 + (((u - 0xD800) << 10) | (u2 - 0xDC00)); // 左移10位表示 *0x400 为什么中间是 | 不是+ ？？
                     }
+                    STAT_ADD(c, unicodes, u >= 0x10000 ? 2 : 1); // 代理对是两个 \uXXXX
                     lept_encode_utf8(c, u);
                     break;
                  default:
                     STRING_ERROR(LEPT_PARSE_INVALID_STRING_ESCAPE);  // 无效转义字符
             }
+            STAT_ADD(c, escapes, 1); // 出错的转义序列上面已经返回，不统计
             break;
         default:
             if((unsigned char)ch < 0x20){ // todo ??
@@ -341,12 +373,110 @@ lept_value* lept_get_array_element(const lept_value* v, size_t index){
     return &(v->u.a.e[index]);
 }
 
+/* 比较两个值，先比较类型、长度，长度不同时不用再比较内容 */
+int lept_equal(const lept_value* lhs, const lept_value* rhs){
+    size_t i;
+    assert(lhs != NULL && rhs != NULL);
+    if(lhs->type != rhs->type)
+        return 0;
+    switch (lhs->type) {
+        case LEPT_NUMBER:
+            return lhs->u.n == rhs->u.n;
+        case LEPT_STRING:
+            return lhs->u.s.len == rhs->u.s.len &&
+                memcmp(lhs->u.s.s, rhs->u.s.s, lhs->u.s.len) == 0;
+        case LEPT_ARRAY:
+            if(lhs->u.a.size != rhs->u.a.size)
+                return 0;
+            for(i = 0; i < lhs->u.a.size; i++){
+                if(!lept_equal(&lhs->u.a.e[i], &rhs->u.a.e[i]))
+                    return 0;
+            }
+            return 1;
+        default: // null true false 类型相同就相等
+            return 1;
+    }
+}
+
+/* 深度复制到一个还没有内容的 dst（不会先释放 dst） */
+static void lept_copy_new(lept_value* dst, const lept_value* src){
+    size_t i;
+    switch (src->type) {
+        case LEPT_STRING:
+            lept_init(dst);
+            lept_set_string(dst, src->u.s.s, src->u.s.len);
+            break;
+        case LEPT_ARRAY:
+            dst->u.a.size = src->u.a.size;
+            dst->u.a.e = src->u.a.size ? (lept_value*)malloc(src->u.a.size * sizeof(lept_value)) : NULL;
+            for(i = 0; i < src->u.a.size; i++)
+                lept_copy_new(&dst->u.a.e[i], &src->u.a.e[i]);
+            dst->type = LEPT_ARRAY;
+            break;
+        default:
+            memcpy(dst, src, sizeof(lept_value));
+            break;
+    }
+}
+
+/* 深度复制，dst 原有的内容会被释放；先复制到临时变量再释放 dst，所以 src 可以是 dst 的一部分 */
+void lept_copy(lept_value* dst, const lept_value* src){
+    lept_value tmp;
+    assert(dst != NULL && src != NULL);
+    lept_copy_new(&tmp, src);
+    lept_free(dst);
+    memcpy(dst, &tmp, sizeof(lept_value));
+}
+
+/*
+    把 dst 替换成 src 的副本，结果和 lept_copy 相同，
+    但类型相同时原地修改，尽量复用 dst 已经分配的字符串和数组内存。
+    src 不能是 dst 的一部分。
+*/
+static void lept_assign_reuse(lept_value* dst, const lept_value* src){
+    size_t i, n;
+    if(dst->type == LEPT_STRING && src->type == LEPT_STRING){
+        n = src->u.s.len;
+        if(n > dst->u.s.len) // 变短时直接复用原来的内存
+            dst->u.s.s = (char*)realloc(dst->u.s.s, n + 1);
+        memcpy(dst->u.s.s, src->u.s.s, n);
+        dst->u.s.s[n] = '\0';
+        dst->u.s.len = n;
+    }
+    else if(dst->type == LEPT_ARRAY && src->type == LEPT_ARRAY){
+        n = src->u.a.size;
+        for(i = n; i < dst->u.a.size; i++) // 多出来的元素释放掉，数组本身的内存不缩小
+            lept_free(&dst->u.a.e[i]);
+        if(n > dst->u.a.size){
+            dst->u.a.e = (lept_value*)realloc(dst->u.a.e, n * sizeof(lept_value));
+            for(i = dst->u.a.size; i < n; i++)
+                lept_init(&dst->u.a.e[i]);
+        }
+        dst->u.a.size = n;
+        for(i = 0; i < n; i++) // 数组是整体替换，元素也是替换而不是合并，只是复用元素里的内存
+            lept_assign_reuse(&dst->u.a.e[i], &src->u.a.e[i]);
+    }
+    else
+        lept_copy(dst, src);
+}
+
+/*
+    RFC 7396 merge patch，原地修改 target。
+    patch 不是对象时，结果就是 patch 本身（数组也是整体替换）。patch 不能是 target 的一部分。
+*/
+void lept_merge_patch(lept_value* target, const lept_value* patch){
+    assert(target != NULL && patch != NULL && target != patch);
+    /* 还没有对象类型；加入对象后，patch 为对象时在这里逐个成员递归 merge，值为 null 的成员从 target 中删除 */
+    lept_assign_reuse(target, patch);
+}
+
 static int lept_parse_value(lept_context* c, lept_value* v); // 前项声明, 因为lept_pass_array用到了这个，这个又用到了array，循环引用
 
 static int lept_parse_array(lept_context* c, lept_value* v){
     size_t size = 0;
     int ret;
     EXPECT(c, '[');
+    STAT_DEPTH_ENTER(c);
     lept_parse_whitespace(c); // dz 解析[ 后面的空白字符： " [ null , false , true , 123 , \"abc\" ] "
 
     if(*c->json == ']'){
@@ -355,6 +485,7 @@ static int lept_parse_array(lept_context* c, lept_value* v){
         v->type = LEPT_ARRAY;
         v->u.a.size = 0;
         v->u.a.e = NULL;
+        STAT_DEPTH_LEAVE(c);
         return LEPT_PARSE_OK;
     }
     for(;;) {
@@ -380,6 +511,8 @@ static int lept_parse_array(lept_context* c, lept_value* v){
             v->u.a.size = size;
             size *= sizeof(lept_value); // size 一开始表示元素个数，现在表示分配的字节数
             memcpy(v->u.a.e = (lept_value*)malloc(size), lept_context_pop(c, size), size); // 将所有入栈的元素弹出，放到 array的e指针里面
+            STAT_ADD(c, array_bytes, size);
+            STAT_DEPTH_LEAVE(c);
             return LEPT_PARSE_OK;
         }else{
             // dz发生了错误，此时要弹出堆栈里面的内容才行！
@@ -391,10 +524,11 @@ static int lept_parse_array(lept_context* c, lept_value* v){
     for (int i=0; i < size; i++){
         lept_free((lept_value*)lept_context_pop(c, sizeof(lept_value))); // 我之前只写了弹出堆栈，但是没有释放分配的内存！
     }
+    STAT_DEPTH_LEAVE(c);
     return ret;
 }
 
-static int lept_parse_value(lept_context* c, lept_value* v){
+static int lept_parse_value_type(lept_context* c, lept_value* v){
     switch (*c->json) {
         case 'n': 
             //return lept_parse_null(c, v);
@@ -419,8 +553,36 @@ static int lept_parse_value(lept_context* c, lept_value* v){
     }
 }
 
+/* 统计关闭时 STAT_ADD 为空，编译器会把它内联成直接调用 lept_parse_value_type */
+static int lept_parse_value(lept_context* c, lept_value* v){
+    int ret = lept_parse_value_type(c, v);
+    if(ret == LEPT_PARSE_OK){
+        STAT_ADD(c, count[v->type], 1);
+    }
+    return ret;
+}
+
 
 
+/* 解析整个 json 文本，调用者负责初始化和释放 c */
+static int lept_parse_root(lept_context* c, lept_value* v){
+    int ret;
+    lept_init(v);
+    v->type = LEPT_NULL;
+    lept_parse_whitespace(c); // json最左边的空白字符已经去掉了
+
+    if((ret = lept_parse_value(c, v)) == LEPT_PARSE_OK){
+        lept_parse_whitespace(c); // 这里的空白字符只有4中，不包含 \0
+        if(*c->json != '\0'){ // 右端的空白字符解析完成之后，结尾还有字符，则错误
+            lept_free(v); // 不能只把 type 改成 null，已经解析出的字符串、数组要释放
+            ret = LEPT_PARSE_ROOT_NOT_SINGULAR;
+        }
+    }
+
+    assert(c->top == 0); // 确保所有数据被弹出
+    return ret;
+}
+
 int lept_parse(lept_value* v, const char* json){ // todo static ??
     lept_context c;
     int ret;
@@ -428,19 +590,174 @@ int lept_parse(lept_value* v, const char* json){ // todo static ??
     c.json = json;
     c.stack = NULL;
     c.size = c.top = 0;
-    lept_init(v);
-    v->type = LEPT_NULL;
-    lept_parse_whitespace(&c); // json最左边的空白字符已经去掉了
+#ifdef LEPT_PARSE_STATS
+    c.stats = NULL;
+    c.depth = 0;
+#endif
+    ret = lept_parse_root(&c, v);
+    free(c.stack);
+    return ret;
+}
 
-    if((ret = lept_parse_value(&c, v)) == LEPT_PARSE_OK){
-        lept_parse_whitespace(&c); // 这里的空白字符只有4中，不包含 \0
-        if(*c.json != '\0'){ // 右端的空白字符解析完成之后，结尾还有字符，则错误
-            v->type = LEPT_NULL;
-            ret = LEPT_PARSE_ROOT_NOT_SINGULAR;
+#ifdef LEPT_PARSE_STATS
+int lept_parse_with_stats(lept_value* v, const char* json, lept_stats* stats){
+    lept_context c;
+    int ret;
+    assert(v != NULL && stats != NULL);
+    memset(stats, 0, sizeof(lept_stats));
+    c.json = json;
+    c.stack = NULL;
+    c.size = c.top = 0;
+    c.stats = stats;
+    c.depth = 0;
+    ret = lept_parse_root(&c, v);
+    stats->bytes = c.json - json;
+    free(c.stack);
+    return ret;
+}
+#endif
+
+#ifndef LEPT_STRINGIFY_CHUNK_SIZE
+#define LEPT_STRINGIFY_CHUNK_SIZE 4096
+#endif /* lept_stringify_to 的 chunk 传 0 时使用 */
+
+/* 固定大小的输出缓冲，写满了就交给 sink，所以内存占用和文档大小无关 */
+typedef struct {
+    char* buf;
+    size_t size, len;
+    lept_write_fn sink;
+    void* ctx;
+    int ret; // 出错之后不再调用 sink
+} lept_writer;
+
+static void lept_writer_flush(lept_writer* w){
+    if(w->len > 0 && w->ret == LEPT_STRINGIFY_OK && w->sink(w->ctx, w->buf, w->len) != 0)
+        w->ret = LEPT_STRINGIFY_WRITE_ERROR;
+    w->len = 0;
+}
+
+/* 先填满缓冲再交给 sink；缓冲为空且这一段不比缓冲短时，不经过缓冲直接写 */
+static void lept_writer_puts(lept_writer* w, const char* s, size_t len){
+    size_t n;
+    while(len > 0){
+        if(w->len == 0 && len >= w->size){
+            if(w->ret == LEPT_STRINGIFY_OK && w->sink(w->ctx, s, len) != 0)
+                w->ret = LEPT_STRINGIFY_WRITE_ERROR;
+            return;
         }
+        n = w->size - w->len;
+        if(n > len)
+            n = len;
+        memcpy(w->buf + w->len, s, n);
+        w->len += n;
+        s += n;
+        len -= n;
+        if(w->len == w->size)
+            lept_writer_flush(w);
     }
+}
 
-    assert(c.top == 0); // 确保所有数据被弹出
-    free(c.stack);
-    return ret;
+static void lept_writer_putc(lept_writer* w, char ch){
+    if(w->len == w->size)
+        lept_writer_flush(w);
+    w->buf[w->len++] = ch;
+}
+
+#define ONES64              (~(uint64_t)0 / 255) /* 每个字节都是 0x01 */
+#define HAS_ZERO_BYTE(x)    (((x) - ONES64) & ~(x) & (ONES64 * 0x80))
+#define HAS_BYTE_LESS(x, n) (((x) - ONES64 * (n)) & ~(x) & (ONES64 * 0x80)) /* n <= 128 */
+
+/*
+    返回 s 开头不需要转义的字节数。
+    每次读 8 个字节（SWAR），同时检查是否有 '"'、'\\' 或小于 0x20 的字节，都没有就整段跳过；
+    有的话再逐个字节找出准确位置。
+*/
+static size_t lept_stringify_plain_run(const char* s, size_t len){
+    size_t i = 0;
+    uint64_t x;
+    for(; i + 8 <= len; i += 8){
+        memcpy(&x, s + i, 8); // 用 memcpy 读，避免未对齐访问
+        if(HAS_ZERO_BYTE(x ^ (ONES64 * '"')) | HAS_ZERO_BYTE(x ^ (ONES64 * '\\')) | HAS_BYTE_LESS(x, 0x20))
+            break;
+    }
+    for(; i < len; i++){
+        unsigned char ch = (unsigned char)s[i];
+        if(ch < 0x20 || ch == '"' || ch == '\\')
+            break;
+    }
+    return i;
+}
+
+static void lept_stringify_string(lept_writer* w, const char* s, size_t len){
+    static const char hex_digits[] = "0123456789ABCDEF";
+    size_t i = 0, run;
+    lept_writer_putc(w, '"');
+    for(;;){
+        run = lept_stringify_plain_run(s + i, len - i);
+        lept_writer_puts(w, s + i, run); // 不需要转义的部分整段写入
+        if((i += run) == len)
+            break;
+        unsigned char ch = (unsigned char)s[i++];
+        switch (ch) {
+            case '\"': lept_writer_puts(w, "\\\"", 2); break;
+            case '\\': lept_writer_puts(w, "\\\\", 2); break;
+            case '\b': lept_writer_puts(w, "\\b", 2); break;
+            case '\f': lept_writer_puts(w, "\\f", 2); break;
+            case '\n': lept_writer_puts(w, "\\n", 2); break;
+            case '\r': lept_writer_puts(w, "\\r", 2); break;
+            case '\t': lept_writer_puts(w, "\\t", 2); break;
+            default: { // 其他控制字符写成 \u00XX
+                char u[6] = { '\\', 'u', '0', '0' };
+                u[4] = hex_digits[ch >> 4];
+                u[5] = hex_digits[ch & 15];
+                lept_writer_puts(w, u, 6);
+            }
+        }
+    }
+    lept_writer_putc(w, '"');
+}
+
+static void lept_stringify_value(lept_writer* w, const lept_value* v){
+    size_t i;
+    char buf[32];
+    if(w->ret != LEPT_STRINGIFY_OK) // sink 已经出错，不用再生成了
+        return;
+    switch (v->type) {
+        case LEPT_NULL:   lept_writer_puts(w, "null",  4); break;
+        case LEPT_FALSE:  lept_writer_puts(w, "false", 5); break;
+        case LEPT_TRUE:   lept_writer_puts(w, "true",  4); break;
+        case LEPT_NUMBER:
+            if(!isfinite(v->u.n)){ // json 里没有 inf 和 nan，不能写出 "inf"、"nan"
+                w->ret = LEPT_STRINGIFY_INVALID_NUMBER;
+                return;
+            }
+            lept_writer_puts(w, buf, sprintf(buf, "%.17g", v->u.n)); // 17 位有效数字才能保证 double 解析回来不变
+            break;
+        case LEPT_STRING: lept_stringify_string(w, v->u.s.s, v->u.s.len); break;
+        case LEPT_ARRAY:
+            lept_writer_putc(w, '[');
+            for(i = 0; i < v->u.a.size; i++){
+                if(i > 0)
+                    lept_writer_putc(w, ',');
+                lept_stringify_value(w, &v->u.a.e[i]);
+            }
+            lept_writer_putc(w, ']');
+            break;
+        default: assert(0 && "invalid type");
+    }
+}
+
+int lept_stringify_to(const lept_value* v, lept_write_fn sink, void* ctx, size_t chunk){
+    lept_writer w;
+    assert(v != NULL && sink != NULL);
+    w.size = chunk ? chunk : LEPT_STRINGIFY_CHUNK_SIZE;
+    w.buf = (char*)malloc(w.size);
+    w.len = 0;
+    w.sink = sink;
+    w.ctx = ctx;
+    w.ret = LEPT_STRINGIFY_OK;
+    lept_stringify_value(&w, v);
+    lept_writer_flush(&w);
+    free(w.buf);
+    return w.ret;
 }
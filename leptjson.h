@@ -1,6 +1,10 @@
 #ifndef LEPTJSON_H
 #define LEPTJSON_H
 
+#ifdef __cplusplus /* 让 C++ 代码（如 leptjson.hpp）可以直接链接这个 C 库 */
+extern "C" {
+#endif
+
 typedef enum {LEPT_NULL, LEPT_FALSE, LEPT_TRUE, LEPT_NUMBER, LEPT_STRING, LEPT_ARRAY, LEPT_OBJECT} lept_type;
 
 #define lept_init(v)        do{ (v) -> type = LEPT_NULL; } while(0)
@@ -29,11 +33,30 @@ enum {
     LEPT_PARSE_INVALID_STRING_CHAR,
     LEPT_PARSE_INVALID_UNICODE_SURROGATE,
     LEPT_PARSE_INVALID_UNICODE_HEX,
-    LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET
+    LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET,
+    LEPT_PARSE_NUMBER_TOO_BIG
 };
 
 int lept_parse(lept_value* v, const char* json);
 
+#ifdef LEPT_PARSE_STATS /* 编译时定义 LEPT_PARSE_STATS 才启用统计，否则整个统计功能都不会被编译进来 */
+typedef struct {
+    size_t bytes;           /* 消耗的 json 字节数（出错时为解析失败的值的起始位置） */
+    size_t count[LEPT_OBJECT + 1]; /* 每种类型解析成功的个数，用 lept_type 作下标 */
+    size_t max_depth;       /* 数组最大嵌套深度，"1" 为 0，"[ ]" 为 1 */
+    size_t stack_peak;      /* lept_context 堆栈 top 的最大值（字节） */
+    size_t stack_size;      /* lept_context 堆栈最终的容量（字节） */
+    size_t stack_reallocs;  /* 堆栈 realloc 的次数 */
+    size_t string_bytes;    /* 为字符串 malloc 的字节数，包含结尾的 '\0' */
+    size_t array_bytes;     /* 为数组元素 malloc 的字节数 */
+    size_t escapes;         /* 合法的转义序列个数，代理对 \uXXXX\uXXXX 算一个 */
+    size_t unicodes;        /* 合法的 \uXXXX 个数，代理对算两个 */
+} lept_stats;
+
+/* 和 lept_parse 一样，同时把统计结果写入 stats（会先清零） */
+int lept_parse_with_stats(lept_value* v, const char* json, lept_stats* stats);
+#endif
+
 void lept_free(lept_value* v);
 
 lept_type lept_get_type(const lept_value* v);
@@ -51,5 +74,27 @@ void lept_set_string(lept_value* v, const char* s, size_t len);
 size_t lept_get_array_size(const lept_value* v);
 lept_value* lept_get_array_element(const lept_value* v, size_t index);
 
+int lept_equal(const lept_value* lhs, const lept_value* rhs);
+void lept_copy(lept_value* dst, const lept_value* src); /* 深度复制，释放 dst 原有内容；src 可以是 dst 的一部分 */
+void lept_merge_patch(lept_value* target, const lept_value* patch); /* RFC 7396，原地修改 target；patch 不能是 target 的一部分 */
+
+enum {
+    LEPT_STRINGIFY_OK = 0,
+    LEPT_STRINGIFY_WRITE_ERROR,
+    LEPT_STRINGIFY_INVALID_NUMBER /* inf 或 nan，已经交给 sink 的部分无法收回 */
+};
+
+/* 输出回调，返回 0 表示成功，非 0 时停止生成 */
+typedef int (*lept_write_fn)(void* ctx, const char* data, size_t len);
+
+/*
+    生成 json，输出先写到 chunk 字节的缓冲里，写满一次调用一次 sink（chunk 为 0 时用 LEPT_STRINGIFY_CHUNK_SIZE）。
+    缓冲为空时，不短于 chunk 的字符串片段会直接传给 sink。
+*/
+int lept_stringify_to(const lept_value* v, lept_write_fn sink, void* ctx, size_t chunk);
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif /* LEPTJSON_H */
@@ -0,0 +1,121 @@
+#ifndef LEPTJSON_HPP
+#define LEPTJSON_HPP
+
+/* leptjson 的 C++17 头文件封装，只包装 C API，不额外分配内存也不复制数据 */
+
+#include <cassert>
+#include <cmath>   /* std::ldexp */
+#include <cstddef> /* size_t，leptjson.h 本身没有包含 */
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <string_view>
+#include <type_traits>
+#include "leptjson.h"
+
+namespace lept {
+
+/* 不拥有数据的只读视图，生命周期不能超过它所指向的 document */
+class value_view {
+public:
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag; /* operator* 返回的是临时的 value_view，不能作 forward iterator */
+        using value_type = value_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_view;
+
+        explicit iterator(const lept_value* p) noexcept : p_(p) {}
+        value_view operator*() const noexcept { return value_view(p_); }
+        iterator& operator++() noexcept { ++p_; return *this; }
+        iterator operator++(int) noexcept { iterator t = *this; ++p_; return t; }
+        bool operator==(const iterator& o) const noexcept { return p_ == o.p_; }
+        bool operator!=(const iterator& o) const noexcept { return p_ != o.p_; }
+
+    private:
+        const lept_value* p_;
+    };
+
+    explicit value_view(const lept_value* v) noexcept : v_(v) {}
+
+    lept_type type() const { return lept_get_type(v_); }
+    bool is_null() const { return type() == LEPT_NULL; }
+    bool is_bool() const { return type() == LEPT_TRUE || type() == LEPT_FALSE; }
+    bool is_number() const { return type() == LEPT_NUMBER; }
+    bool is_string() const { return type() == LEPT_STRING; }
+    bool is_array() const { return type() == LEPT_ARRAY; }
+
+    /* 和 C API 一样，类型不符时由 assert 检查 */
+    template <class T>
+    T get() const {
+        if constexpr (std::is_same_v<T, bool>)
+            return lept_get_boolean(v_) != 0;
+        else if constexpr (std::is_floating_point_v<T>)
+            return static_cast<T>(lept_get_number(v_));
+        else if constexpr (std::is_integral_v<T>) { /* int64_t 等整数，小数部分截断，超出 T 的范围（包括 inf、nan）由 assert 检查 */
+            double n = lept_get_number(v_);
+            double limit = std::ldexp(1.0, std::numeric_limits<T>::digits); /* 2^digits，T 的最大值 + 1 */
+            assert(n < limit && (std::is_signed_v<T> ? n >= -limit : n > -1.0));
+            return static_cast<T>(n);
+        }
+        else if constexpr (std::is_same_v<T, std::string_view>)
+            return std::string_view(lept_get_string(v_), lept_get_string_length(v_));
+        else if constexpr (std::is_same_v<T, const char*>)
+            return lept_get_string(v_);
+        else
+            static_assert(!sizeof(T), "lept::value_view::get<T>: unsupported type");
+    }
+
+    std::string_view string() const { return get<std::string_view>(); }
+
+    /* 数组访问 */
+    size_t size() const { return lept_get_array_size(v_); }
+    value_view operator[](size_t index) const { return value_view(lept_get_array_element(v_, index)); }
+    /* 元素在 u.a.e 中连续存放，end 不能用 lept_get_array_element（它会 assert 下标越界） */
+    iterator begin() const { assert(is_array()); return iterator(v_->u.a.e); }
+    iterator end() const { assert(is_array()); return iterator(v_->u.a.e + size()); }
+
+    const lept_value* c_ptr() const noexcept { return v_; }
+
+private:
+    const lept_value* v_;
+};
+
+/* 拥有一棵 lept_value 树，析构时自动 lept_free；只能移动，不能复制 */
+class document {
+public:
+    document() noexcept { lept_init(&v_); }
+    ~document() { lept_free(&v_); }
+
+    document(const document&) = delete;
+    document& operator=(const document&) = delete;
+
+    /* lept_value 是普通的 C 结构体，移动就是按位复制后把原对象置为 null */
+    document(document&& o) noexcept : v_(o.v_) { lept_init(&o.v_); }
+    document& operator=(document&& o) noexcept {
+        if (this != &o) {
+            lept_free(&v_);
+            v_ = o.v_;
+            lept_init(&o.v_);
+        }
+        return *this;
+    }
+
+    /* 返回 LEPT_PARSE_* 错误码，失败时 document 为 null */
+    int parse(const char* json) {
+        lept_free(&v_); /* lept_parse 不会释放 v 原有的内容 */
+        return lept_parse(&v_, json);
+    }
+
+    value_view root() const noexcept { return value_view(&v_); }
+    lept_value* c_ptr() noexcept { return &v_; }
+    const lept_value* c_ptr() const noexcept { return &v_; }
+
+private:
+    lept_value v_;
+};
+
+} /* namespace lept */
+
+#endif /* LEPTJSON_HPP */
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h> /* HUGE_VAL */
 #include "leptjson.h"
 
 static int main_ret = 0; // 之前这里一直报错，原因是 上面leptjson的结构体定义结尾没有加上分号;
@@ -13,6 +14,7 @@ static int test_pass = 0;
         if (equality)\
             test_pass++;\
         else {\
+            main_ret = 1;\
             fprintf(stderr, "%s:%d: expect: " format " actual: " format "\n", __FILE__, __LINE__, expect, actual);\
         }\
     } while(0)
@@ -52,12 +54,32 @@ static int test_pass = 0;
     } while(0)
 
 static void test_parse_string(){
-//    TEST_STRING("", "\"\"");
+    TEST_STRING("", "\"\"");
     TEST_STRING("Hello", "\"Hello\"");
-#if 0
     TEST_STRING("Hello\nWorld", "\"Hello\\nWorld\"");
     TEST_STRING("\" \\ / \b \f \n \r \t", "\"\\\" \\\\ \\/ \\b \\f \\n \\r \\t\"");
-#endif
+    TEST_STRING("\x24", "\"\\u0024\"");         /* Dollar sign U+0024 */
+    TEST_STRING("\xC2\xA2", "\"\\u00A2\"");     /* Cents sign U+00A2 */
+    TEST_STRING("\xE2\x82\xAC", "\"\\u20AC\""); /* Euro sign U+20AC */
+    TEST_STRING("\xF0\x9D\x84\x9E", "\"\\uD834\\uDD1E\"");  /* G clef sign U+1D11E */
+    TEST_STRING("\xF0\x9D\x84\x9E", "\"\\ud834\\udd1e\"");  /* G clef sign U+1D11E */
+}
+
+static void test_parse_invalid_unicode(){
+    TEST_ERROR(LEPT_PARSE_INVALID_UNICODE_HEX, "\"\\u\"");
+    TEST_ERROR(LEPT_PARSE_INVALID_UNICODE_HEX, "\"\\u0\"");
+    TEST_ERROR(LEPT_PARSE_INVALID_UNICODE_HEX, "\"\\u01\"");
+    TEST_ERROR(LEPT_PARSE_INVALID_UNICODE_HEX, "\"\\u012\"");
+    TEST_ERROR(LEPT_PARSE_INVALID_UNICODE_HEX, "\"\\u/000\"");
+    TEST_ERROR(LEPT_PARSE_INVALID_UNICODE_HEX, "\"\\uG000\"");
+    TEST_ERROR(LEPT_PARSE_INVALID_UNICODE_HEX, "\"\\u0G00\"");
+    TEST_ERROR(LEPT_PARSE_INVALID_UNICODE_HEX, "\"\\u00G0\"");
+    TEST_ERROR(LEPT_PARSE_INVALID_UNICODE_HEX, "\"\\u000G\"");
+    TEST_ERROR(LEPT_PARSE_INVALID_UNICODE_SURROGATE, "\"\\uD800\"");
+    TEST_ERROR(LEPT_PARSE_INVALID_UNICODE_SURROGATE, "\"\\uDBFF\"");
+    TEST_ERROR(LEPT_PARSE_INVALID_UNICODE_SURROGATE, "\"\\uD800\\\\\"");
+    TEST_ERROR(LEPT_PARSE_INVALID_UNICODE_SURROGATE, "\"\\uD800\\uDBFF\"");
+    TEST_ERROR(LEPT_PARSE_INVALID_UNICODE_SURROGATE, "\"\\uD800\\uE000\"");
 }
 
 static void test_parse_null() {
@@ -171,6 +193,12 @@ static void test_parse_invalid_value() {
     TEST_ERROR(LEPT_PARSE_INVALID_VALUE, "nan");
 }
 
+static void test_parse_number_too_big(){
+    TEST_ERROR(LEPT_PARSE_NUMBER_TOO_BIG, "1e309");
+    TEST_ERROR(LEPT_PARSE_NUMBER_TOO_BIG, "-1e309");
+    TEST_ERROR(LEPT_PARSE_NUMBER_TOO_BIG, "[1e400, -1e400]");
+}
+
 /* 只是测试获取字符串，实际主要测试的是设置字符串设置的是否正确 */
 static void test_access_string(){
     lept_value v;
@@ -249,20 +277,272 @@ static void test_parse_array(){
     lept_free(&v);
 }
 
+#define TEST_EQUAL(json1, json2, equality) \
+    do {\
+        lept_value v1, v2;\
+        lept_init(&v1);\
+        lept_init(&v2);\
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v1, json1));\
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v2, json2));\
+        EXPECT_EQ_INT(equality, lept_equal(&v1, &v2));\
+        lept_free(&v1);\
+        lept_free(&v2);\
+    } while(0)
+
+static void test_equal(){
+    TEST_EQUAL("true", "true", 1);
+    TEST_EQUAL("true", "false", 0);
+    TEST_EQUAL("false", "false", 1);
+    TEST_EQUAL("null", "null", 1);
+    TEST_EQUAL("null", "0", 0);
+    TEST_EQUAL("123", "123", 1);
+    TEST_EQUAL("123", "456", 0);
+    TEST_EQUAL("\"abc\"", "\"abc\"", 1);
+    TEST_EQUAL("\"abc\"", "\"abcd\"", 0);
+    TEST_EQUAL("[]", "[]", 1);
+    TEST_EQUAL("[]", "null", 0);
+    TEST_EQUAL("[1,2,3]", "[1,2,3]", 1);
+    TEST_EQUAL("[1,2,3]", "[1,2,3,4]", 0);
+    TEST_EQUAL("[[]]", "[[]]", 1);
+    TEST_EQUAL("[[1,\"a\"]]", "[[1,\"b\"]]", 0);
+}
+
+static void test_copy(){
+    lept_value v1, v2;
+    lept_init(&v1);
+    lept_init(&v2);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v1, "[\"abc\", [1, \"x\"], null]"));
+    lept_copy(&v2, &v1);
+    EXPECT_TRUE(lept_equal(&v1, &v2));
+    EXPECT_TRUE(lept_get_array_element(&v1, 0) != lept_get_array_element(&v2, 0));
+
+    /* src 是 dst 的一部分 */
+    lept_copy(&v2, lept_get_array_element(&v2, 1));
+    EXPECT_TRUE(lept_equal(lept_get_array_element(&v1, 1), &v2));
+    lept_copy(&v2, &v2);
+    EXPECT_TRUE(lept_equal(lept_get_array_element(&v1, 1), &v2));
+    lept_free(&v1);
+    lept_free(&v2);
+}
+
+#define TEST_MERGE_PATCH(target_json, patch_json) \
+    do {\
+        lept_value t, p;\
+        lept_init(&t);\
+        lept_init(&p);\
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&t, target_json));\
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&p, patch_json));\
+        lept_merge_patch(&t, &p);\
+        EXPECT_TRUE(lept_equal(&t, &p));\
+        lept_free(&t);\
+        lept_free(&p);\
+    } while(0)
+
+static void test_merge_patch(){
+    lept_value t, p;
+    const char* s;
+    const lept_value* e;
+
+    TEST_MERGE_PATCH("null", "\"abc\"");
+    TEST_MERGE_PATCH("\"abc\"", "123");
+    TEST_MERGE_PATCH("\"abc\"", "\"a\"");
+    TEST_MERGE_PATCH("\"a\"", "\"abcdef\"");
+    TEST_MERGE_PATCH("[1, \"abc\", [2]]", "[]");
+    TEST_MERGE_PATCH("[]", "[1, \"abc\", [2]]");
+    TEST_MERGE_PATCH("[1, \"abc\", [2, 3]]", "[\"x\", \"ab\"]");
+    TEST_MERGE_PATCH("[\"x\"]", "[1, [\"abc\", null], true]");
+    TEST_MERGE_PATCH("[[1, 2], 3]", "\"abc\"");
+
+    /* 字符串变短、数组元素减少时复用原来的内存 */
+    lept_init(&t);
+    lept_init(&p);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&t, "[\"hello\", 1, 2]"));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&p, "[\"hi\"]"));
+    e = lept_get_array_element(&t, 0);
+    s = lept_get_string(e);
+    lept_merge_patch(&t, &p);
+    EXPECT_TRUE(lept_get_array_element(&t, 0) == e);
+    EXPECT_TRUE(lept_get_string(e) == s);
+    EXPECT_EQ_SIZE_T(1, lept_get_array_size(&t));
+    EXPECT_EQ_STRING("hi", lept_get_string(e), lept_get_string_length(e));
+    lept_free(&t);
+    lept_free(&p);
+}
+
+/* 把 lept_stringify_to 的输出收集起来，记录 sink 被调用的次数和最大的一块 */
+typedef struct {
+    char buf[256];
+    size_t len, calls, max_chunk;
+} test_sink_ctx;
+
+static int test_sink(void* ctx, const char* data, size_t len){
+    test_sink_ctx* t = (test_sink_ctx*)ctx;
+    if (t->len + len > sizeof(t->buf))
+        return -1;
+    memcpy(t->buf + t->len, data, len);
+    t->len += len;
+    t->calls++;
+    if (len > t->max_chunk)
+        t->max_chunk = len;
+    return 0;
+}
+
+static int test_sink_fail(void* ctx, const char* data, size_t len){
+    (void)data;
+    (void)len;
+    (*(size_t*)ctx)++;
+    return -1;
+}
+
+/* 解析再生成，结果要和原来的 json 一样；chunk 取几个不同大小，检查缓冲边界 */
+#define TEST_ROUNDTRIP(json)\
+    do {\
+        lept_value v;\
+        test_sink_ctx t;\
+        size_t chunks[] = { 0, 1, 2, 7 }, k;\
+        lept_init(&v);\
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v, json));\
+        for (k = 0; k < sizeof(chunks) / sizeof(chunks[0]); k++) {\
+            memset(&t, 0, sizeof(t));\
+            EXPECT_EQ_INT(LEPT_STRINGIFY_OK, lept_stringify_to(&v, test_sink, &t, chunks[k]));\
+            EXPECT_EQ_STRING(json, t.buf, t.len);\
+        }\
+        lept_free(&v);\
+    } while(0)
+
+static void test_stringify(){
+    lept_value v;
+    test_sink_ctx t;
+    size_t calls = 0;
+
+    TEST_ROUNDTRIP("null");
+    TEST_ROUNDTRIP("false");
+    TEST_ROUNDTRIP("true");
+    TEST_ROUNDTRIP("0");
+    TEST_ROUNDTRIP("-0");
+    TEST_ROUNDTRIP("1");
+    TEST_ROUNDTRIP("-1");
+    TEST_ROUNDTRIP("1.5");
+    TEST_ROUNDTRIP("3.25");
+    TEST_ROUNDTRIP("1e+20");
+    TEST_ROUNDTRIP("1.234e+20");
+    TEST_ROUNDTRIP("1.234e-20");
+    TEST_ROUNDTRIP("1.0000000000000002"); /* the smallest number > 1 */
+    TEST_ROUNDTRIP("4.9406564584124654e-324"); /* minimum denormal */
+    TEST_ROUNDTRIP("1.7976931348623157e+308");  /* Max double */
+
+    TEST_ROUNDTRIP("\"\"");
+    TEST_ROUNDTRIP("\"Hello\"");
+    TEST_ROUNDTRIP("\"Hello\\nWorld\"");
+    TEST_ROUNDTRIP("\"\\\" \\\\ / \\b \\f \\n \\r \\t\"");
+    TEST_ROUNDTRIP("\"Hello\\u0000World\"");
+    TEST_ROUNDTRIP("\"\\u001F long enough to be scanned 8 bytes at a time\\\"!\"");
+
+    TEST_ROUNDTRIP("[]");
+    TEST_ROUNDTRIP("[null,false,true,123,\"abc\",[1,2,3]]");
+
+    /* 输出被切成 chunk 大小的块，最后一块可以更短 */
+    lept_init(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v, "[\"abc\",[1,2,3]]"));
+    memset(&t, 0, sizeof(t));
+    EXPECT_EQ_INT(LEPT_STRINGIFY_OK, lept_stringify_to(&v, test_sink, &t, 4));
+    EXPECT_EQ_STRING("[\"abc\",[1,2,3]]", t.buf, t.len);
+    EXPECT_TRUE(t.max_chunk <= 4);
+    EXPECT_EQ_SIZE_T(4, t.calls);
+
+    /* sink 出错后不再被调用 */
+    EXPECT_EQ_INT(LEPT_STRINGIFY_WRITE_ERROR, lept_stringify_to(&v, test_sink_fail, &calls, 1));
+    EXPECT_EQ_SIZE_T(1, calls);
+    lept_free(&v);
+
+    /* inf、nan 不能生成 json，遇到时停止，后面的内容不再交给 sink */
+    lept_init(&v);
+    lept_set_number(&v, HUGE_VAL);
+    memset(&t, 0, sizeof(t));
+    EXPECT_EQ_INT(LEPT_STRINGIFY_INVALID_NUMBER, lept_stringify_to(&v, test_sink, &t, 0));
+    EXPECT_EQ_SIZE_T(0, t.len);
+    lept_set_number(&v, -HUGE_VAL);
+    EXPECT_EQ_INT(LEPT_STRINGIFY_INVALID_NUMBER, lept_stringify_to(&v, test_sink, &t, 0));
+    lept_set_number(&v, HUGE_VAL - HUGE_VAL); /* nan */
+    EXPECT_EQ_INT(LEPT_STRINGIFY_INVALID_NUMBER, lept_stringify_to(&v, test_sink, &t, 0));
+    EXPECT_EQ_SIZE_T(0, t.len);
+
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v, "[1,2,3]"));
+    lept_set_number(lept_get_array_element(&v, 1), HUGE_VAL);
+    EXPECT_EQ_INT(LEPT_STRINGIFY_INVALID_NUMBER, lept_stringify_to(&v, test_sink, &t, 1));
+    EXPECT_EQ_STRING("[1", t.buf, t.len); /* 已经交给 sink 的部分收不回来，还在缓冲里的 "," 不再写出 */
+    lept_free(&v);
+}
+
+#ifdef LEPT_PARSE_STATS
+static void test_parse_stats(){
+    lept_value v;
+    lept_stats s;
+    lept_init(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_with_stats(&v, " [ null , [ true , 1 ] , \"a\\n\\t\" ] ", &s));
+    EXPECT_EQ_SIZE_T(35, s.bytes);
+    EXPECT_EQ_SIZE_T(1, s.count[LEPT_NULL]);
+    EXPECT_EQ_SIZE_T(1, s.count[LEPT_TRUE]);
+    EXPECT_EQ_SIZE_T(1, s.count[LEPT_NUMBER]);
+    EXPECT_EQ_SIZE_T(1, s.count[LEPT_STRING]);
+    EXPECT_EQ_SIZE_T(2, s.count[LEPT_ARRAY]);
+    EXPECT_EQ_SIZE_T(2, s.max_depth);
+    EXPECT_EQ_SIZE_T(2, s.escapes);
+    EXPECT_EQ_SIZE_T(0, s.unicodes);
+    EXPECT_EQ_SIZE_T(4, s.string_bytes); /* "a\n\t" + '\0' */
+    EXPECT_EQ_SIZE_T(5 * sizeof(lept_value), s.array_bytes);
+    EXPECT_EQ_SIZE_T(1, s.stack_reallocs);
+    EXPECT_EQ_SIZE_T(256, s.stack_size);
+    EXPECT_EQ_SIZE_T(3 * sizeof(lept_value), s.stack_peak);
+    lept_free(&v);
+
+    /* 出错时也会统计已经完成的部分 */
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_VALUE, lept_parse_with_stats(&v, "[[[1,?", &s));
+    EXPECT_EQ_SIZE_T(3, s.max_depth);
+    EXPECT_EQ_SIZE_T(1, s.count[LEPT_NUMBER]);
+    EXPECT_EQ_SIZE_T(0, s.count[LEPT_ARRAY]);
+    EXPECT_EQ_SIZE_T(5, s.bytes);
+
+    /* 代理对算一个转义、两个 \uXXXX */
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_with_stats(&v, "\"\\u00A2\\uD834\\uDD1E\"", &s));
+    EXPECT_EQ_SIZE_T(2, s.escapes);
+    EXPECT_EQ_SIZE_T(3, s.unicodes);
+    lept_free(&v);
+
+    /* 不合法的转义不统计 */
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_STRING_ESCAPE, lept_parse_with_stats(&v, "\"\\n\\x\"", &s));
+    EXPECT_EQ_SIZE_T(1, s.escapes);
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_UNICODE_HEX, lept_parse_with_stats(&v, "\"\\u12G4\"", &s));
+    EXPECT_EQ_SIZE_T(0, s.escapes);
+    EXPECT_EQ_SIZE_T(0, s.unicodes);
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_UNICODE_SURROGATE, lept_parse_with_stats(&v, "\"\\uD800\\uE000\"", &s));
+    EXPECT_EQ_SIZE_T(0, s.unicodes);
+}
+#endif
+
 static void test_parse(){
     test_parse_null();
     test_parse_expect_value();
     test_parse_invalid_value();
     test_parse_root_not_singular();
+    test_parse_number_too_big();
     test_pare_true();
     test_pare_false();
     test_parse_number();
     test_parse_invalid_value();
     test_access_string();
     test_parse_string();
+    test_parse_invalid_unicode();
     test_access_boolean();
     test_access_number();
     test_parse_array();
+    test_equal();
+    test_copy();
+    test_merge_patch();
+    test_stringify();
+#ifdef LEPT_PARSE_STATS
+    test_parse_stats();
+#endif
 }
 
 int main(){
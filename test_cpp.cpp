@@ -0,0 +1,101 @@
+/* leptjson.hpp 的测试，和 test.c 用同样的 EXPECT 宏风格 */
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <utility>
+#include "leptjson.hpp"
+
+static int main_ret = 0;
+static int test_count = 0;
+static int test_pass = 0;
+
+#define EXPECT_EQ_BASE(equality, expect, actual, format) \
+    do {\
+        test_count++;\
+        if (equality)\
+            test_pass++;\
+        else {\
+            main_ret = 1;\
+            std::fprintf(stderr, "%s:%d: expect: " format " actual: " format "\n", __FILE__, __LINE__, expect, actual);\
+        }\
+    } while(0)
+
+#define EXPECT_EQ_INT(expect, actual) EXPECT_EQ_BASE((expect) == (actual), (int)(expect), (int)(actual), "%d")
+#define EXPECT_EQ_LL(expect, actual) EXPECT_EQ_BASE((expect) == (actual), (long long)(expect), (long long)(actual), "%lld")
+#define EXPECT_EQ_DOUBLE(expect, actual) EXPECT_EQ_BASE((expect) == (actual), (double)(expect), (double)(actual), "%.17g")
+#define EXPECT_EQ_SIZE_T(expect, actual) EXPECT_EQ_BASE((expect) == (actual), (size_t)(expect), (size_t)(actual), "%zu")
+#define EXPECT_TRUE(actual) EXPECT_EQ_BASE((actual) != 0, "true", "false", "%s")
+
+static void test_document_move(){
+    lept::document d;
+    EXPECT_TRUE(d.root().is_null());
+    EXPECT_EQ_INT(LEPT_PARSE_OK, d.parse("[\"abc\", [1, 2]]"));
+    const lept_value* tree = d.c_ptr()->u.a.e;
+
+    lept::document e = std::move(d); /* 移动构造不复制元素 */
+    EXPECT_TRUE(d.root().is_null());
+    EXPECT_TRUE(e.root().is_array());
+    EXPECT_TRUE(e.c_ptr()->u.a.e == tree);
+
+    lept::document f;
+    EXPECT_EQ_INT(LEPT_PARSE_OK, f.parse("\"old\""));
+    f = std::move(e); /* 移动赋值释放 f 原来的字符串 */
+    EXPECT_TRUE(e.root().is_null());
+    EXPECT_TRUE(f.c_ptr()->u.a.e == tree);
+    EXPECT_EQ_SIZE_T(2, f.root().size());
+
+    /* 重复 parse 和析构都会释放之前的内容，用 LEPT_SANITIZE 编译时由 LeakSanitizer 检查 */
+    EXPECT_EQ_INT(LEPT_PARSE_OK, f.parse("[[\"x\"]]"));
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_VALUE, f.parse("[?]"));
+    EXPECT_TRUE(f.root().is_null());
+}
+
+static void test_get(){
+    lept::document d;
+    EXPECT_EQ_INT(LEPT_PARSE_OK, d.parse("[true, false, 2.5, -3.75, 1e15, \"a\\u0000b\"]"));
+    lept::value_view r = d.root();
+    EXPECT_TRUE(r[0].get<bool>());
+    EXPECT_TRUE(!r[1].get<bool>());
+    EXPECT_EQ_DOUBLE(2.5, r[2].get<double>());
+    EXPECT_EQ_DOUBLE(2.5f, r[2].get<float>());
+    EXPECT_EQ_LL(2, r[2].get<int>());
+    EXPECT_EQ_LL(-3, r[3].get<int64_t>());
+    EXPECT_EQ_LL(1000000000000000LL, r[4].get<int64_t>());
+    EXPECT_EQ_LL(1000000000000000ULL, r[4].get<uint64_t>());
+
+    std::string_view s = r[5].string();
+    EXPECT_EQ_SIZE_T(3, s.size());
+    EXPECT_TRUE(s == std::string_view("a\0b", 3));
+    EXPECT_TRUE(s.data() == lept_get_string(r[5].c_ptr())); /* 不复制字符串 */
+    EXPECT_TRUE(r[5].get<std::string_view>() == s);
+    EXPECT_TRUE(std::strcmp(r[5].get<const char*>(), "a") == 0);
+}
+
+static void test_range_for(){
+    lept::document d;
+    size_t n = 0;
+    double sum = 0.0;
+    EXPECT_EQ_INT(LEPT_PARSE_OK, d.parse("[1, 2, 3, 4]"));
+    for (lept::value_view e : d.root()) {
+        sum += e.get<double>();
+        n++;
+    }
+    EXPECT_EQ_SIZE_T(4, n);
+    EXPECT_EQ_DOUBLE(10.0, sum);
+
+    EXPECT_EQ_INT(LEPT_PARSE_OK, d.parse("[ ]"));
+    n = 0;
+    for (lept::value_view e : d.root()) {
+        (void)e;
+        n++;
+    }
+    EXPECT_EQ_SIZE_T(0, n);
+}
+
+int main(){
+    test_document_move();
+    test_get();
+    test_range_for();
+    std::printf("%d/%d (%3.2f%%) passed\n", test_pass, test_count, test_pass * 100.0 / test_count);
+    return main_ret;
+}